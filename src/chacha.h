@@ -0,0 +1,20 @@
+#ifndef GLITCH_CHACHA_H
+#define GLITCH_CHACHA_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define CHACHA_BLOCK 64
+
+/* ChaCha20 keystream with a 64-bit block counter and 64-bit nonce
+ * (words 12-13 and 14-15), so one key covers 2^70 bytes. */
+void chacha20_blocks(const unsigned char key[32], uint64_t nonce,
+                     uint64_t counter, unsigned char *out, size_t nblocks);
+void chacha20_blocks_scalar(const unsigned char key[32], uint64_t nonce,
+                            uint64_t counter, unsigned char *out, size_t nblocks);
+
+/* Known-answer check of both code paths against RFC 8439; 0 on success. */
+int chacha20_selftest(void);
+const char *chacha20_impl(void);
+
+#endif
@@ -1,11 +1,140 @@
+#include <dlfcn.h>
 #include <limits.h>
 #include <png.h>
+#include <pthread.h>
+#include <setjmp.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
 #include "img.h"
 
+/*
+ * libpng (and zlib behind it) is opened on first use rather than linked, so
+ * runs that never decode or encode an image skip loading it. Every call goes
+ * through this table; the prototypes come from png.h.
+ */
+#define LIBPNG_STR_(x) #x
+#define LIBPNG_STR(x) LIBPNG_STR_(x)
+#define LIBPNG_SONAME "libpng" LIBPNG_STR(PNG_LIBPNG_VER_DLLNUM) ".so." LIBPNG_STR(PNG_LIBPNG_VER_SONUM)
+
+static struct {
+    __typeof__(png_create_info_struct) *create_info_struct;
+    __typeof__(png_create_read_struct) *create_read_struct;
+    __typeof__(png_create_write_struct) *create_write_struct;
+    __typeof__(png_destroy_read_struct) *destroy_read_struct;
+    __typeof__(png_destroy_write_struct) *destroy_write_struct;
+    __typeof__(png_error) *error;
+    __typeof__(png_get_bit_depth) *get_bit_depth;
+    __typeof__(png_get_color_type) *get_color_type;
+    __typeof__(png_get_image_height) *get_image_height;
+    __typeof__(png_get_image_width) *get_image_width;
+    __typeof__(png_get_io_ptr) *get_io_ptr;
+    __typeof__(png_get_progressive_ptr) *get_progressive_ptr;
+    __typeof__(png_get_rowbytes) *get_rowbytes;
+    __typeof__(png_get_valid) *get_valid;
+    __typeof__(png_init_io) *init_io;
+    __typeof__(png_process_data) *process_data;
+    __typeof__(png_progressive_combine_row) *progressive_combine_row;
+    __typeof__(png_read_end) *read_end;
+    __typeof__(png_read_info) *read_info;
+    __typeof__(png_read_row) *read_row;
+    __typeof__(png_read_update_info) *read_update_info;
+    __typeof__(png_set_IHDR) *set_IHDR;
+    __typeof__(png_set_add_alpha) *set_add_alpha;
+    __typeof__(png_set_compression_level) *set_compression_level;
+    __typeof__(png_set_expand_gray_1_2_4_to_8) *set_expand_gray_1_2_4_to_8;
+    __typeof__(png_set_gray_to_rgb) *set_gray_to_rgb;
+    __typeof__(png_set_interlace_handling) *set_interlace_handling;
+    __typeof__(png_set_longjmp_fn) *set_longjmp_fn;
+    __typeof__(png_set_palette_to_rgb) *set_palette_to_rgb;
+    __typeof__(png_set_progressive_read_fn) *set_progressive_read_fn;
+    __typeof__(png_set_read_fn) *set_read_fn;
+    __typeof__(png_set_strip_16) *set_strip_16;
+    __typeof__(png_set_tRNS_to_alpha) *set_tRNS_to_alpha;
+    __typeof__(png_set_write_fn) *set_write_fn;
+    __typeof__(png_sig_cmp) *sig_cmp;
+    __typeof__(png_write_end) *write_end;
+    __typeof__(png_write_info) *write_info;
+    __typeof__(png_write_row) *write_row;
+} lpng;
+
+static pthread_once_t lpng_once = PTHREAD_ONCE_INIT;
+static int lpng_ok;
+
+/* png_jmpbuf() expands to a direct png_set_longjmp_fn() call */
+#define PNG_JMPBUF(png) (*lpng.set_longjmp_fn((png), longjmp, sizeof(jmp_buf)))
+
+static void
+lpng_open(void)
+{
+    void *h = dlopen(LIBPNG_SONAME, RTLD_NOW | RTLD_LOCAL);
+
+    if (!h)
+        h = dlopen("libpng.so", RTLD_NOW | RTLD_LOCAL);
+    if (!h)
+        return;
+#define LPNG_SYM(f)                                                         \
+    do {                                                                    \
+        if (!(lpng.f = (__typeof__(lpng.f))dlsym(h, "png_" #f))) {          \
+            dlclose(h);                                                     \
+            return;                                                         \
+        }                                                                   \
+    } while (0)
+    LPNG_SYM(create_info_struct);
+    LPNG_SYM(create_read_struct);
+    LPNG_SYM(create_write_struct);
+    LPNG_SYM(destroy_read_struct);
+    LPNG_SYM(destroy_write_struct);
+    LPNG_SYM(error);
+    LPNG_SYM(get_bit_depth);
+    LPNG_SYM(get_color_type);
+    LPNG_SYM(get_image_height);
+    LPNG_SYM(get_image_width);
+    LPNG_SYM(get_io_ptr);
+    LPNG_SYM(get_progressive_ptr);
+    LPNG_SYM(get_rowbytes);
+    LPNG_SYM(get_valid);
+    LPNG_SYM(init_io);
+    LPNG_SYM(process_data);
+    LPNG_SYM(progressive_combine_row);
+    LPNG_SYM(read_end);
+    LPNG_SYM(read_info);
+    LPNG_SYM(read_row);
+    LPNG_SYM(read_update_info);
+    LPNG_SYM(set_IHDR);
+    LPNG_SYM(set_add_alpha);
+    LPNG_SYM(set_compression_level);
+    LPNG_SYM(set_expand_gray_1_2_4_to_8);
+    LPNG_SYM(set_gray_to_rgb);
+    LPNG_SYM(set_interlace_handling);
+    LPNG_SYM(set_longjmp_fn);
+    LPNG_SYM(set_palette_to_rgb);
+    LPNG_SYM(set_progressive_read_fn);
+    LPNG_SYM(set_read_fn);
+    LPNG_SYM(set_strip_16);
+    LPNG_SYM(set_tRNS_to_alpha);
+    LPNG_SYM(set_write_fn);
+    LPNG_SYM(sig_cmp);
+    LPNG_SYM(write_end);
+    LPNG_SYM(write_info);
+    LPNG_SYM(write_row);
+#undef LPNG_SYM
+    lpng_ok = 1;
+}
+
+/* 1 once libpng is usable */
+static int
+lpng_load(void)
+{
+    pthread_once(&lpng_once, lpng_open);
+    return lpng_ok;
+}
+
 struct mem_reader {
     const unsigned char *buf;
     size_t len;
@@ -15,54 +144,70 @@ struct mem_reader {
 static void
 png_read_mem(png_structp png, png_bytep out, png_size_t len)
 {
-    struct mem_reader *r = png_get_io_ptr(png);
+    struct mem_reader *r = lpng.get_io_ptr(png);
 
     if (!r || r->pos + len > r->len)
-        png_error(png, "png mem underrun");
+        lpng.error(png, "png mem underrun");
 
     memcpy(out, r->buf + r->pos, len);
     r->pos += len;
 }
 
+/* Expand every PNG flavour to 8-bit RGBA; returns the number of interlace passes. */
 static int
-decode_rgba(png_structp png, png_infop info, unsigned char **out_rgba, int *w, int *h)
+setup_rgba(png_structp png, png_infop info)
 {
-    png_uint_32 width, height;
-    int bit_depth, color_type;
-    png_size_t rowbytes;
-    unsigned char *pixels, *row;
+    int bit_depth, color_type, passes;
 
-    png_get_IHDR(png, info, &width, &height, &bit_depth, &color_type, NULL, NULL, NULL);
-    if (!width || !height || width > (png_uint_32)INT_MAX || height > (png_uint_32)INT_MAX)
-        return 0;
+    bit_depth = lpng.get_bit_depth(png, info);
+    color_type = lpng.get_color_type(png, info);
 
     if (bit_depth == 16)
-        png_set_strip_16(png);
+        lpng.set_strip_16(png);
     if (color_type == PNG_COLOR_TYPE_PALETTE)
-        png_set_palette_to_rgb(png);
+        lpng.set_palette_to_rgb(png);
     if (color_type == PNG_COLOR_TYPE_GRAY && bit_depth < 8)
-        png_set_expand_gray_1_2_4_to_8(png);
-    if (png_get_valid(png, info, PNG_INFO_tRNS))
-        png_set_tRNS_to_alpha(png);
+        lpng.set_expand_gray_1_2_4_to_8(png);
+    if (lpng.get_valid(png, info, PNG_INFO_tRNS))
+        lpng.set_tRNS_to_alpha(png);
     if (!(color_type & PNG_COLOR_MASK_ALPHA))
-        png_set_add_alpha(png, 0xFF, PNG_FILLER_AFTER);
+        lpng.set_add_alpha(png, 0xFF, PNG_FILLER_AFTER);
     if (color_type == PNG_COLOR_TYPE_GRAY || color_type == PNG_COLOR_TYPE_GRAY_ALPHA)
-        png_set_gray_to_rgb(png);
+        lpng.set_gray_to_rgb(png);
 
-    png_set_interlace_handling(png);
-    png_read_update_info(png, info);
+    passes = lpng.set_interlace_handling(png);
+    lpng.read_update_info(png, info);
+    return passes;
+}
 
-    rowbytes = png_get_rowbytes(png, info);
+static int
+decode_rgba(png_structp png, png_infop info, unsigned char **out_rgba, int *w, int *h)
+{
+    png_uint_32 width, height;
+    png_size_t rowbytes;
+    unsigned char *pixels, *row;
+    int passes;
+
+    width = lpng.get_image_width(png, info);
+    height = lpng.get_image_height(png, info);
+    if (!width || !height || width > (png_uint_32)INT_MAX || height > (png_uint_32)INT_MAX)
+        return 0;
+
+    passes = setup_rgba(png, info);
+
+    rowbytes = lpng.get_rowbytes(png, info);
     pixels = malloc(rowbytes * height);
     if (!pixels)
         return 0;
 
-    row = pixels;
-    for (png_uint_32 y = 0; y < height; ++y) {
-        png_read_row(png, row, NULL);
-        row += rowbytes;
+    for (int pass = 0; pass < passes; ++pass) {
+        row = pixels;
+        for (png_uint_32 y = 0; y < height; ++y) {
+            lpng.read_row(png, row, NULL);
+            row += rowbytes;
+        }
     }
-    png_read_end(png, info);
+    lpng.read_end(png, info);
 
     *out_rgba = pixels;
     *w = (int)width;
@@ -78,28 +223,28 @@ img_load_rgba(const char *path, unsigned char **out_rgba, int *w, int *h)
     FILE *fp;
     int ok = 0;
 
-    if (!path || !out_rgba || !w || !h)
+    if (!path || !out_rgba || !w || !h || !lpng_load())
         return 0;
 
     fp = fopen(path, "rb");
     if (!fp)
         return 0;
 
-    png = png_create_read_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
-    info = png ? png_create_info_struct(png) : NULL;
+    png = lpng.create_read_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
+    info = png ? lpng.create_info_struct(png) : NULL;
     if (!png || !info)
         goto done;
 
-    if (setjmp(png_jmpbuf(png)))
+    if (setjmp(PNG_JMPBUF(png)))
         goto done;
 
-    png_init_io(png, fp);
-    png_read_info(png, info);
+    lpng.init_io(png, fp);
+    lpng.read_info(png, info);
     ok = decode_rgba(png, info, out_rgba, w, h);
 
 done:
     if (png || info)
-        png_destroy_read_struct(&png, &info, NULL);
+        lpng.destroy_read_struct(&png, &info, NULL);
     fclose(fp);
     return ok;
 }
@@ -112,40 +257,436 @@ img_load_rgba_mem(const unsigned char *buf, int len, unsigned char **out_rgba, i
     struct mem_reader reader;
     int ok = 0;
 
-    if (!buf || len <= 8 || !out_rgba || !w || !h)
+    if (!buf || len <= 8 || !out_rgba || !w || !h || !lpng_load())
         return 0;
 
-    if (png_sig_cmp((png_bytep)buf, 0, 8) != 0)
+    if (lpng.sig_cmp((png_bytep)buf, 0, 8) != 0)
         return 0;
 
     reader.buf = buf;
     reader.len = (size_t)len;
     reader.pos = 0;
 
-    png = png_create_read_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
-    info = png ? png_create_info_struct(png) : NULL;
+    png = lpng.create_read_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
+    info = png ? lpng.create_info_struct(png) : NULL;
     if (!png || !info)
         return 0;
 
-    if (setjmp(png_jmpbuf(png))) {
-        png_destroy_read_struct(&png, &info, NULL);
+    if (setjmp(PNG_JMPBUF(png))) {
+        lpng.destroy_read_struct(&png, &info, NULL);
         return 0;
     }
 
-    png_set_read_fn(png, &reader, png_read_mem);
-    png_read_info(png, info);
+    lpng.set_read_fn(png, &reader, png_read_mem);
+    lpng.read_info(png, info);
     ok = decode_rgba(png, info, out_rgba, w, h);
-    png_destroy_read_struct(&png, &info, NULL);
+    lpng.destroy_read_struct(&png, &info, NULL);
+
+    return ok;
+}
+
+/*
+ * Area-averaging downscale in 16.16 fixed point. Each output pixel is the
+ * coverage-weighted mean of the source pixels under it, done as two separable
+ * passes: rows are filtered horizontally into a small ring (8 fractional bits)
+ * and the ring is blended vertically. The inner loops are flat uint32 arrays
+ * so the compiler can vectorise them.
+ */
+#define BOX_ONE 65536u
+
+static int
+box_axis(int sn, int dn, int taps, int *start, uint32_t *weight)
+{
+    for (int d = 0; d < dn; ++d) {
+        uint64_t lo = (uint64_t)d * sn, hi = lo + sn; /* in 1/dn source pixels */
+        int s0 = (int)(lo / dn);
+        uint32_t sum = 0;
+        int last = 0;
+
+        if (s0 > sn - taps)
+            s0 = sn - taps;
+        start[d] = s0;
+        for (int t = 0; t < taps; ++t) {
+            uint64_t a = (uint64_t)(s0 + t) * dn, b = a + dn, ov = 0;
+            uint32_t w;
+
+            if (b > lo && a < hi)
+                ov = (b < hi ? b : hi) - (a > lo ? a : lo);
+            w = (uint32_t)((ov * BOX_ONE + (uint64_t)sn / 2) / (uint64_t)sn);
+            weight[(size_t)d * taps + t] = w;
+            sum += w;
+            if (w)
+                last = t;
+        }
+        weight[(size_t)d * taps + last] += BOX_ONE - sum; /* exact unit gain */
+    }
+    return 1;
+}
+
+static void
+box_row(const unsigned char *src, int dw, int taps, const int *start,
+        const uint32_t *weight, uint32_t *out)
+{
+    for (int d = 0; d < dw; ++d) {
+        const unsigned char *p = src + (size_t)start[d] * 4;
+        const uint32_t *w = weight + (size_t)d * taps;
+        uint32_t r = 0, g = 0, b = 0, a = 0;
+
+        for (int t = 0; t < taps; ++t, p += 4) {
+            r += w[t] * p[0];
+            g += w[t] * p[1];
+            b += w[t] * p[2];
+            a += w[t] * p[3];
+        }
+        out[d * 4 + 0] = r >> 8;
+        out[d * 4 + 1] = g >> 8;
+        out[d * 4 + 2] = b >> 8;
+        out[d * 4 + 3] = a >> 8;
+    }
+}
+
+int
+img_downscale_box(const unsigned char *src, int sw, int sh,
+                  unsigned char *dst, int dw, int dh)
+{
+    int xtaps, ytaps, ok = 0;
+    int *xstart, *ystart, *tag;
+    uint32_t *xw, *yw, *ring, *acc;
+    size_t n = (size_t)dw * 4;
 
+    if (!src || !dst || dw <= 0 || dh <= 0 || dw > sw || dh > sh)
+        return 0;
+
+    xtaps = sw / dw + 2;
+    if (xtaps > sw)
+        xtaps = sw;
+    ytaps = sh / dh + 2;
+    if (ytaps > sh)
+        ytaps = sh;
+
+    xstart = malloc(sizeof(int) * (size_t)dw);
+    ystart = malloc(sizeof(int) * (size_t)dh);
+    tag = malloc(sizeof(int) * (size_t)ytaps);
+    xw = malloc(sizeof(uint32_t) * (size_t)dw * xtaps);
+    yw = malloc(sizeof(uint32_t) * (size_t)dh * ytaps);
+    ring = malloc(sizeof(uint32_t) * n * ytaps);
+    acc = malloc(sizeof(uint32_t) * n);
+    if (!xstart || !ystart || !tag || !xw || !yw || !ring || !acc)
+        goto done;
+
+    box_axis(sw, dw, xtaps, xstart, xw);
+    box_axis(sh, dh, ytaps, ystart, yw);
+    for (int t = 0; t < ytaps; ++t)
+        tag[t] = -1;
+
+    for (int y = 0; y < dh; ++y) {
+        unsigned char *out = dst + (size_t)y * n;
+
+        for (size_t i = 0; i < n; ++i)
+            acc[i] = 1u << 23; /* rounding bias for the final >> 24 */
+        for (int t = 0; t < ytaps; ++t) {
+            int sy = ystart[y] + t;
+            int slot = sy % ytaps;
+            uint32_t w = yw[(size_t)y * ytaps + t];
+            uint32_t *restrict a = acc;
+            const uint32_t *restrict h = ring + (size_t)slot * n;
+
+            if (!w)
+                continue;
+            if (tag[slot] != sy) {
+                box_row(src + (size_t)sy * sw * 4, dw, xtaps, xstart, xw,
+                        ring + (size_t)slot * n);
+                tag[slot] = sy;
+            }
+            for (size_t i = 0; i < n; ++i)
+                a[i] += w * h[i];
+        }
+        for (size_t i = 0; i < n; ++i)
+            out[i] = (unsigned char)(acc[i] >> 24);
+    }
+    ok = 1;
+
+done:
+    free(xstart);
+    free(ystart);
+    free(tag);
+    free(xw);
+    free(yw);
+    free(ring);
+    free(acc);
     return ok;
 }
 
+/* Exact 2x2 box filter for mip chains; dst is (w / 2) x (h / 2). */
+int
+img_halve(const unsigned char *src, int w, int h, unsigned char *dst)
+{
+    int dw = w / 2, dh = h / 2;
+
+    if (!src || !dst || dw <= 0 || dh <= 0)
+        return 0;
+
+    for (int y = 0; y < dh; ++y) {
+        const unsigned char *r0 = src + (size_t)(2 * y) * w * 4;
+        const unsigned char *r1 = r0 + (size_t)w * 4;
+        unsigned char *out = dst + (size_t)y * dw * 4;
+        int x = 0;
+
+#ifdef __SSE2__
+        const __m128i z = _mm_setzero_si128();
+        const __m128i two = _mm_set1_epi16(2);
+
+        for (; x + 4 <= dw; x += 4) {
+            __m128i a0 = _mm_loadu_si128((const __m128i *)(r0 + x * 8));
+            __m128i a1 = _mm_loadu_si128((const __m128i *)(r0 + x * 8 + 16));
+            __m128i b0 = _mm_loadu_si128((const __m128i *)(r1 + x * 8));
+            __m128i b1 = _mm_loadu_si128((const __m128i *)(r1 + x * 8 + 16));
+            __m128i s0 = _mm_add_epi16(_mm_unpacklo_epi8(a0, z), _mm_unpacklo_epi8(b0, z));
+            __m128i s1 = _mm_add_epi16(_mm_unpackhi_epi8(a0, z), _mm_unpackhi_epi8(b0, z));
+            __m128i s2 = _mm_add_epi16(_mm_unpacklo_epi8(a1, z), _mm_unpacklo_epi8(b1, z));
+            __m128i s3 = _mm_add_epi16(_mm_unpackhi_epi8(a1, z), _mm_unpackhi_epi8(b1, z));
+            __m128i t0 = _mm_add_epi16(_mm_unpacklo_epi64(s0, s1), _mm_unpackhi_epi64(s0, s1));
+            __m128i t1 = _mm_add_epi16(_mm_unpacklo_epi64(s2, s3), _mm_unpackhi_epi64(s2, s3));
+
+            t0 = _mm_srli_epi16(_mm_add_epi16(t0, two), 2);
+            t1 = _mm_srli_epi16(_mm_add_epi16(t1, two), 2);
+            _mm_storeu_si128((__m128i *)(out + x * 4), _mm_packus_epi16(t0, t1));
+        }
+#endif
+        for (; x < dw; ++x) {
+            const unsigned char *p = r0 + x * 8, *q = r1 + x * 8;
+
+            for (int c = 0; c < 4; ++c)
+                out[x * 4 + c] = (unsigned char)((p[c] + p[c + 4] + q[c] + q[c + 4] + 2) >> 2);
+        }
+    }
+    return 1;
+}
+
+/*
+ * 64-bit difference hash: area-average down to 9x8 luma and set one bit per
+ * horizontally adjacent pair that gets brighter. Re-encoded or rescaled copies
+ * of a picture land within a few bits of each other.
+ */
+int
+img_dhash(const unsigned char *rgba, int w, int h, uint64_t *out)
+{
+    unsigned char grid[9 * 8 * 4];
+    int luma[9 * 8];
+    uint64_t bits = 0;
+
+    if (!out || !img_downscale_box(rgba, w, h, grid, 9, 8))
+        return 0;
+    for (int i = 0; i < 9 * 8; ++i)
+        luma[i] = grid[i * 4] * 77 + grid[i * 4 + 1] * 150 + grid[i * 4 + 2] * 29;
+    for (int y = 0; y < 8; ++y) {
+        for (int x = 0; x < 8; ++x) {
+            bits <<= 1;
+            bits |= luma[y * 9 + x] < luma[y * 9 + x + 1];
+        }
+    }
+    *out = bits;
+    return 1;
+}
+
+/*
+ * Streaming decode: the caller feeds compressed bytes as they arrive (e.g. from
+ * a curl write callback) and libpng's progressive reader hands back rows. Rows
+ * inside the center square go straight into the output, so peak memory is the
+ * output plus libpng's own row buffer. Interlaced images need every pass of a
+ * row before it is final, so they keep a full-width band covering the crop.
+ */
+#define IMG_STREAM_MAX_DIM 16384
+
+struct img_stream {
+    png_structp png;
+    png_infop info;
+    unsigned char *out;
+    unsigned char *band;
+    png_size_t rowbytes;
+    int side, x0, y0;
+    int rows_left;
+    int failed;
+};
+
+static void
+stream_info_cb(png_structp png, png_infop info)
+{
+    struct img_stream *s = lpng.get_progressive_ptr(png);
+    png_uint_32 width, height;
+    int passes;
+
+    width = lpng.get_image_width(png, info);
+    height = lpng.get_image_height(png, info);
+    if (!width || !height || width > IMG_STREAM_MAX_DIM || height > IMG_STREAM_MAX_DIM)
+        lpng.error(png, "png stream: bad dimensions");
+
+    passes = setup_rgba(png, info);
+    s->rowbytes = lpng.get_rowbytes(png, info);
+    s->side = (int)(width < height ? width : height);
+    s->x0 = ((int)width - s->side) / 2;
+    s->y0 = ((int)height - s->side) / 2;
+    s->rows_left = s->side;
+
+    s->out = malloc((size_t)s->side * s->side * 4);
+    if (!s->out)
+        lpng.error(png, "png stream: out of memory");
+    if (passes > 1) {
+        s->band = calloc((size_t)s->side, s->rowbytes);
+        if (!s->band)
+            lpng.error(png, "png stream: out of memory");
+    }
+}
+
+static void
+stream_row_cb(png_structp png, png_bytep new_row, png_uint_32 row_num, int pass)
+{
+    struct img_stream *s = lpng.get_progressive_ptr(png);
+    int y = (int)row_num - s->y0;
+    size_t span = (size_t)s->side * 4;
+
+    (void)pass;
+    if (!new_row || y < 0 || y >= s->side)
+        return;
+
+    if (s->band) {
+        lpng.progressive_combine_row(png, s->band + (size_t)y * s->rowbytes, new_row);
+        return;
+    }
+    memcpy(s->out + (size_t)y * span, new_row + (size_t)s->x0 * 4, span);
+    s->rows_left--;
+}
+
+static void
+stream_end_cb(png_structp png, png_infop info)
+{
+    struct img_stream *s = lpng.get_progressive_ptr(png);
+    size_t span;
+
+    (void)info;
+    if (!s->band)
+        return;
+    span = (size_t)s->side * 4;
+    for (int y = 0; y < s->side; ++y)
+        memcpy(s->out + (size_t)y * span, s->band + (size_t)y * s->rowbytes + (size_t)s->x0 * 4, span);
+    s->rows_left = 0;
+}
+
+struct img_stream *
+img_stream_new(void)
+{
+    struct img_stream *s;
+
+    if (!lpng_load())
+        return NULL;
+    s = calloc(1, sizeof(*s));
+    if (!s)
+        return NULL;
+    s->png = lpng.create_read_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
+    s->info = s->png ? lpng.create_info_struct(s->png) : NULL;
+    if (!s->png || !s->info) {
+        img_stream_free(s);
+        return NULL;
+    }
+    s->rows_left = -1;
+    lpng.set_progressive_read_fn(s->png, s, stream_info_cb, stream_row_cb, stream_end_cb);
+    return s;
+}
+
+int
+img_stream_feed(struct img_stream *s, const unsigned char *buf, size_t len)
+{
+    if (!s || s->failed)
+        return 0;
+    if (s->rows_left == 0 || len == 0)
+        return 1; /* crop complete; trailing chunks are irrelevant */
+
+    if (setjmp(PNG_JMPBUF(s->png))) {
+        s->failed = 1;
+        return 0;
+    }
+    lpng.process_data(s->png, s->info, (png_bytep)buf, len);
+    return 1;
+}
+
+int
+img_stream_finish(struct img_stream *s, unsigned char **out_rgba, int *side)
+{
+    if (!s || s->failed || s->rows_left != 0 || !out_rgba)
+        return 0;
+
+    *out_rgba = s->out;
+    s->out = NULL;
+    if (side)
+        *side = s->side;
+    return 1;
+}
+
+void
+img_stream_free(struct img_stream *s)
+{
+    if (!s)
+        return;
+    if (s->png || s->info)
+        lpng.destroy_read_struct(&s->png, &s->info, NULL);
+    free(s->band);
+    free(s->out);
+    free(s);
+}
+
 void
 img_free(unsigned char *p)
 {
     free(p);
 }
 
+struct mem_writer {
+    unsigned char *buf;
+    size_t len;
+    size_t cap;
+};
+
+static void
+png_write_mem(png_structp png, png_bytep data, png_size_t len)
+{
+    struct mem_writer *w = lpng.get_io_ptr(png);
+
+    if (w->len + len > w->cap) {
+        size_t cap = w->cap ? w->cap : 4096;
+        unsigned char *grown;
+
+        while (cap < w->len + len)
+            cap *= 2;
+        grown = realloc(w->buf, cap);
+        if (!grown)
+            lpng.error(png, "png mem overflow");
+        w->buf = grown;
+        w->cap = cap;
+    }
+    memcpy(w->buf + w->len, data, len);
+    w->len += len;
+}
+
+static void
+png_flush_mem(png_structp png)
+{
+    (void)png;
+}
+
+static void
+write_rgba(png_structp png, png_infop info, int w, int h, const unsigned char *rgba)
+{
+    lpng.set_IHDR(png, info, (png_uint_32)w, (png_uint_32)h, 8,
+                 PNG_COLOR_TYPE_RGBA, PNG_INTERLACE_NONE,
+                 PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
+    lpng.write_info(png, info);
+
+    for (int y = 0; y < h; ++y)
+        lpng.write_row(png, (png_bytep)(rgba + (size_t)w * 4 * y));
+
+    lpng.write_end(png, NULL);
+}
+
 int
 img_write_png(const char *path, int w, int h, const unsigned char *rgba)
 {
@@ -154,36 +695,66 @@ img_write_png(const char *path, int w, int h, const unsigned char *rgba)
     FILE *fp;
     int ok = 0;
 
-    if (!path || !rgba || w <= 0 || h <= 0)
+    if (!path || !rgba || w <= 0 || h <= 0 || !lpng_load())
         return 0;
 
     fp = fopen(path, "wb");
     if (!fp)
         return 0;
 
-    png = png_create_write_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
-    info = png ? png_create_info_struct(png) : NULL;
+    png = lpng.create_write_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
+    info = png ? lpng.create_info_struct(png) : NULL;
     if (!png || !info)
         goto done;
 
-    if (setjmp(png_jmpbuf(png)))
+    if (setjmp(PNG_JMPBUF(png)))
         goto done;
 
-    png_init_io(png, fp);
-    png_set_IHDR(png, info, (png_uint_32)w, (png_uint_32)h, 8,
-                 PNG_COLOR_TYPE_RGBA, PNG_INTERLACE_NONE,
-                 PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
-    png_write_info(png, info);
+    lpng.init_io(png, fp);
+    write_rgba(png, info, w, h, rgba);
+    ok = 1;
 
-    for (int y = 0; y < h; ++y)
-        png_write_row(png, (png_bytep)(rgba + (size_t)w * 4 * y));
+done:
+    if (png || info)
+        lpng.destroy_write_struct(&png, &info);
+    fclose(fp);
+    return ok;
+}
+
+/* Encode to a malloc'd buffer at maximum compression, for sending inline. */
+int
+img_encode_png(int w, int h, const unsigned char *rgba,
+               unsigned char **out, size_t *out_len)
+{
+    struct mem_writer mw = { NULL, 0, 0 };
+    png_structp png;
+    png_infop info;
+    int ok = 0;
+
+    if (!rgba || !out || !out_len || w <= 0 || h <= 0 || !lpng_load())
+        return 0;
+
+    png = lpng.create_write_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
+    info = png ? lpng.create_info_struct(png) : NULL;
+    if (!png || !info)
+        goto done;
+
+    if (setjmp(PNG_JMPBUF(png)))
+        goto done;
 
-    png_write_end(png, NULL);
+    lpng.set_write_fn(png, &mw, png_write_mem, png_flush_mem);
+    lpng.set_compression_level(png, 9);
+    write_rgba(png, info, w, h, rgba);
     ok = 1;
 
 done:
     if (png || info)
-        png_destroy_write_struct(&png, &info);
-    fclose(fp);
+        lpng.destroy_write_struct(&png, &info);
+    if (ok) {
+        *out = mw.buf;
+        *out_len = mw.len;
+    } else {
+        free(mw.buf);
+    }
     return ok;
 }
@@ -1,11 +1,28 @@
 #ifndef GLITCH_IMG_H
 #define GLITCH_IMG_H
 
+#include <stddef.h>
 #include <stdint.h>
 
+/* Progressive PNG decoder that center-crops to a square while data arrives. */
+struct img_stream;
+
 int img_load_rgba(const char *path, unsigned char **out_rgba, int *w, int *h);
 int img_load_rgba_mem(const unsigned char *buf, int len, unsigned char **out_rgba, int *w, int *h);
 void img_free(unsigned char *p);
 int img_write_png(const char *path, int w, int h, const unsigned char *rgba);
+int img_encode_png(int w, int h, const unsigned char *rgba,
+                   unsigned char **out, size_t *out_len);
+
+int img_downscale_box(const unsigned char *src, int sw, int sh,
+                      unsigned char *dst, int dw, int dh);
+int img_halve(const unsigned char *src, int w, int h, unsigned char *dst);
+/* 9x8 difference hash; 1 with *out set, 0 if the image can't be sampled. */
+int img_dhash(const unsigned char *rgba, int w, int h, uint64_t *out);
+
+struct img_stream *img_stream_new(void);
+int img_stream_feed(struct img_stream *s, const unsigned char *buf, size_t len);
+int img_stream_finish(struct img_stream *s, unsigned char **out_rgba, int *side);
+void img_stream_free(struct img_stream *s);
 
 #endif
@@ -0,0 +1,284 @@
+#include <math.h>
+#include <string.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#ifdef __SSSE3__
+#include <tmmintrin.h>
+#endif
+
+#include "randtest.h"
+
+static uint64_t
+load64_le(const unsigned char *p)
+{
+    uint64_t w;
+
+    memcpy(&w, p, sizeof(w));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    w = __builtin_bswap64(w);
+#endif
+    return w;
+}
+
+#ifdef __SSSE3__
+/* nibble-table popcount, summed per 64-bit lane */
+static __m128i
+popcnt_epi64(__m128i v)
+{
+    const __m128i lut = _mm_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+    const __m128i low = _mm_set1_epi8(0x0f);
+    __m128i lo = _mm_shuffle_epi8(lut, _mm_and_si128(v, low));
+    __m128i hi = _mm_shuffle_epi8(lut, _mm_and_si128(_mm_srli_epi16(v, 4), low));
+
+    return _mm_sad_epu8(_mm_add_epi8(lo, hi), _mm_setzero_si128());
+}
+#endif
+
+/* Ones and bit transitions inside p[0..n). */
+static void
+count_bits(struct randtest_acc *acc, const unsigned char *p, size_t n)
+{
+    const uint64_t inner = 0x7fffffffffffffffULL;
+    uint64_t ones = 0, trans = 0;
+    size_t i = 0;
+
+#ifdef __SSSE3__
+    __m128i vo = _mm_setzero_si128(), vt = _mm_setzero_si128();
+    const __m128i vinner = _mm_set1_epi64x((long long)inner);
+
+    for (; i + 16 <= n; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(p + i));
+        __m128i t = _mm_and_si128(_mm_xor_si128(v, _mm_srli_epi64(v, 1)), vinner);
+
+        vo = _mm_add_epi64(vo, popcnt_epi64(v));
+        vt = _mm_add_epi64(vt, popcnt_epi64(t));
+    }
+    {
+        uint64_t lanes[2];
+
+        _mm_storeu_si128((__m128i *)lanes, vo);
+        ones += lanes[0] + lanes[1];
+        _mm_storeu_si128((__m128i *)lanes, vt);
+        trans += lanes[0] + lanes[1];
+    }
+#endif
+    for (; i + 8 <= n; i += 8) {
+        uint64_t w = load64_le(p + i);
+
+        ones += (uint64_t)__builtin_popcountll(w);
+        trans += (uint64_t)__builtin_popcountll((w ^ (w >> 1)) & inner);
+    }
+    /* word boundaries: top bit of one word against bit 0 of the next */
+    for (size_t k = 8; k < i; k += 8)
+        trans += ((p[k - 1] >> 7) ^ p[k]) & 1;
+    for (; i < n; ++i) {
+        ones += (uint64_t)__builtin_popcount(p[i]);
+        trans += (uint64_t)__builtin_popcount((p[i] ^ (p[i] >> 1)) & 0x7f);
+        if (i > 0)
+            trans += ((p[i - 1] >> 7) ^ p[i]) & 1;
+    }
+    acc->ones += ones;
+    acc->transitions += trans;
+}
+
+/* Four interleaved tables so runs of equal bytes don't serialize on one
+ * counter; folded into the 64-bit histogram at the end. */
+static void
+count_bytes(struct randtest_acc *acc, const unsigned char *p, size_t n)
+{
+    uint32_t h[4][256];
+    size_t i = 0;
+
+    memset(h, 0, sizeof(h));
+    for (; i + 4 <= n; i += 4) {
+        ++h[0][p[i]];
+        ++h[1][p[i + 1]];
+        ++h[2][p[i + 2]];
+        ++h[3][p[i + 3]];
+    }
+    for (; i < n; ++i)
+        ++h[0][p[i]];
+    for (int b = 0; b < 256; ++b)
+        acc->hist[b] += (uint64_t)h[0][b] + h[1][b] + h[2][b] + h[3][b];
+}
+
+/* sum of p[i] * p[i + 1] */
+static void
+count_pairs(struct randtest_acc *acc, const unsigned char *p, size_t n)
+{
+    uint64_t sum = 0;
+    size_t i = 0;
+
+#ifdef __SSE2__
+    const __m128i z = _mm_setzero_si128();
+
+    while (i + 17 <= n) {
+        /* each step adds < 2^19 per lane; flush before 32 bits overflow */
+        __m128i vs = z;
+        uint32_t lanes[4];
+
+        for (int k = 0; k < 4096 && i + 17 <= n; ++k, i += 16) {
+            __m128i a = _mm_loadu_si128((const __m128i *)(p + i));
+            __m128i b = _mm_loadu_si128((const __m128i *)(p + i + 1));
+
+            vs = _mm_add_epi32(vs, _mm_madd_epi16(_mm_unpacklo_epi8(a, z), _mm_unpacklo_epi8(b, z)));
+            vs = _mm_add_epi32(vs, _mm_madd_epi16(_mm_unpackhi_epi8(a, z), _mm_unpackhi_epi8(b, z)));
+        }
+        _mm_storeu_si128((__m128i *)lanes, vs);
+        sum += (uint64_t)lanes[0] + lanes[1] + lanes[2] + lanes[3];
+    }
+#endif
+    for (; i + 1 < n; ++i)
+        sum += (uint64_t)p[i] * p[i + 1];
+    acc->sum_xy += sum;
+}
+
+void
+randtest_block(struct randtest_acc *acc, const unsigned char *p, size_t n)
+{
+    /* keep the 32-bit histogram tables from wrapping */
+    while (n > 0) {
+        size_t chunk = n > ((size_t)1 << 30) ? ((size_t)1 << 30) : n;
+
+        count_bits(acc, p, chunk);
+        count_bytes(acc, p, chunk);
+        count_pairs(acc, p, chunk);
+        acc->bytes += chunk;
+        p += chunk;
+        n -= chunk;
+        if (n > 0)
+            randtest_join(acc, p[-1], p[0]);
+    }
+}
+
+void
+randtest_join(struct randtest_acc *acc, unsigned char last, unsigned char first)
+{
+    acc->transitions += ((last >> 7) ^ first) & 1;
+    acc->sum_xy += (uint64_t)last * first;
+}
+
+void
+randtest_merge(struct randtest_acc *dst, const struct randtest_acc *src)
+{
+    dst->bytes += src->bytes;
+    dst->ones += src->ones;
+    dst->transitions += src->transitions;
+    dst->sum_xy += src->sum_xy;
+    for (int b = 0; b < 256; ++b)
+        dst->hist[b] += src->hist[b];
+}
+
+/* Regularized upper incomplete gamma Q(a, x): series below a + 1,
+ * Lentz continued fraction above. */
+static double
+igamc(double a, double x)
+{
+    const double eps = 1e-15, tiny = 1e-300;
+    double lead;
+
+    if (x <= 0.0)
+        return 1.0;
+    lead = exp(-x + a * log(x) - lgamma(a));
+    if (x < a + 1.0) {
+        double ap = a, del = 1.0 / a, sum = del;
+
+        for (int i = 0; i < 1000; ++i) {
+            ap += 1.0;
+            del *= x / ap;
+            sum += del;
+            if (fabs(del) < fabs(sum) * eps)
+                break;
+        }
+        return 1.0 - sum * lead;
+    } else {
+        double b = x + 1.0 - a, c = 1.0 / tiny, d = 1.0 / b, h = d;
+
+        for (int i = 1; i < 1000; ++i) {
+            double an = -i * (i - a), del;
+
+            b += 2.0;
+            d = an * d + b;
+            if (fabs(d) < tiny)
+                d = tiny;
+            c = b + an / c;
+            if (fabs(c) < tiny)
+                c = tiny;
+            d = 1.0 / d;
+            del = d * c;
+            h *= del;
+            if (fabs(del - 1.0) < eps)
+                break;
+        }
+        return h * lead;
+    }
+}
+
+void
+randtest_finish(const struct randtest_acc *acc, struct randtest_result *r)
+{
+    double n = (double)acc->bytes, bits = n * 8.0;
+    double sx = 0.0, sxx = 0.0;
+
+    memset(r, 0, sizeof(*r));
+    r->bytes = acc->bytes;
+    if (acc->bytes < 2)
+        return;
+
+    /* NIST SP 800-22 frequency (monobit) */
+    r->monobit_p = erfc(fabs(2.0 * (double)acc->ones - bits) / sqrt(bits) / sqrt(2.0));
+
+    /* NIST SP 800-22 runs, with its frequency prerequisite */
+    {
+        double pi = (double)acc->ones / bits;
+        double v = (double)acc->transitions + 1.0;
+
+        if (fabs(pi - 0.5) >= 2.0 / sqrt(bits))
+            r->runs_p = 0.0;
+        else
+            r->runs_p = erfc(fabs(v - 2.0 * bits * pi * (1.0 - pi)) /
+                             (2.0 * sqrt(2.0 * bits) * pi * (1.0 - pi)));
+    }
+
+    /* byte-frequency chi-square, 255 degrees of freedom */
+    {
+        double e = n / 256.0, chi2 = 0.0, h = 0.0;
+
+        for (int b = 0; b < 256; ++b) {
+            double c = (double)acc->hist[b], d = c - e;
+
+            chi2 += d * d / e;
+            sx += (double)b * c;
+            sxx += (double)b * b * c;
+            if (c > 0.0)
+                h -= (c / n) * log2(c / n);
+        }
+        r->chi2 = chi2;
+        r->chi2_p = igamc(255.0 / 2.0, chi2 / 2.0);
+        r->entropy = h;
+        r->compress_pct = (8.0 - h) / 8.0 * 100.0;
+        r->mean = sx / n;
+    }
+
+    /* lag-1 serial correlation (as in ent); ~N(0, 1/n) for random data */
+    {
+        double den = n * sxx - sx * sx;
+
+        r->serial = den > 0.0 ? (n * (double)acc->sum_xy - sx * sx) / den : 1.0;
+        r->serial_p = erfc(fabs(r->serial) * sqrt(n) / sqrt(2.0));
+    }
+}
+
+const char *
+randtest_impl(void)
+{
+#if defined(__SSSE3__)
+    return "ssse3";
+#elif defined(__SSE2__)
+    return "sse2";
+#else
+    return "scalar";
+#endif
+}
@@ -0,0 +1,39 @@
+#ifndef GLITCH_RANDTEST_H
+#define GLITCH_RANDTEST_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Streaming randomness statistics. The bit order is LSB first within each
+ * byte. Blocks can be accumulated in any order on any thread; the terms that
+ * straddle two consecutive blocks are added with randtest_join.
+ */
+struct randtest_acc {
+    uint64_t bytes;
+    uint64_t ones;
+    uint64_t transitions;   /* adjacent bits that differ */
+    uint64_t sum_xy;        /* sum of x[i] * x[i + 1] over bytes */
+    uint64_t hist[256];
+};
+
+struct randtest_result {
+    uint64_t bytes;
+    double monobit_p;
+    double runs_p;
+    double chi2;
+    double chi2_p;
+    double serial;          /* lag-1 byte correlation coefficient */
+    double serial_p;
+    double mean;
+    double entropy;         /* Shannon bits per byte */
+    double compress_pct;    /* best-case size reduction implied by entropy */
+};
+
+void randtest_block(struct randtest_acc *acc, const unsigned char *p, size_t n);
+void randtest_join(struct randtest_acc *acc, unsigned char last, unsigned char first);
+void randtest_merge(struct randtest_acc *dst, const struct randtest_acc *src);
+void randtest_finish(const struct randtest_acc *acc, struct randtest_result *r);
+const char *randtest_impl(void);
+
+#endif